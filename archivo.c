@@ -0,0 +1,41 @@
+/**
+ * @file      archivo.c
+ * @brief     Rutas temporales para publicar archivos de forma atómica: se escribe en <archivo>.tmp y se renombra al terminar.
+ * @date      2026-10-18
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "archivo.h"
+
+/**
+ * @brief Construye la ruta temporal de un archivo (<filename>.tmp).
+ *
+ * @param filename  Nombre final del archivo
+ * @param temporal  Buffer de LARGO_RUTA bytes donde se deja la ruta temporal
+ * @throw Termina el programa si la ruta no cabe, para nunca escribir ni publicar un nombre truncado
+ */
+void temp_path(const char *filename, char *temporal)
+{
+  if (snprintf(temporal, LARGO_RUTA, "%s.tmp", filename) >= LARGO_RUTA)
+  {
+    printf("La ruta %s es demasiado larga\n", filename);
+    exit(EXIT_FAILURE);
+  }
+}
+
+/**
+ * @brief Publica un archivo renombrando su ruta temporal al nombre final.
+ *
+ * @param filename  Nombre final del archivo
+ * @return true si se publicó, false si falló rename (errno indica la causa)
+ */
+bool publish_file(const char *filename)
+{
+  char temporal[LARGO_RUTA];
+  temp_path(filename, temporal);
+
+  return rename(temporal, filename) == 0;
+}
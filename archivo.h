@@ -0,0 +1,11 @@
+#ifndef ARCHIVO_H
+#define ARCHIVO_H
+
+#include <stdbool.h>
+
+#define LARGO_RUTA 1000 /* Largo maximo de una ruta, incluido el sufijo temporal */
+
+void temp_path(const char *filename, char *temporal);
+bool publish_file(const char *filename);
+
+#endif
@@ -9,12 +9,18 @@
  *
  */
 
+#define _GNU_SOURCE /* F_SETPIPE_SZ, strsep */
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
 #include <errno.h>
+#include <signal.h>
+#include <getopt.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
 #include <sys/wait.h>
 #include <sys/types.h>
 
@@ -26,6 +32,11 @@
 #define LECTURA 0
 #define ESCRITURA 1
 
+#define PIPE_DESCOMPRESION (1 << 20) /* Capacidad del pipe entre el descompresor y el tokenizador */
+#define ESPERA_WORKERS_US 10000      /* Intervalo con que se revisan los timeouts mientras no termine ningún worker */
+
+static pid_t descompresor_pid = -1;
+
 void create_process(int *pid)
 {
   *pid = fork();
@@ -41,8 +52,17 @@ void create_process(int *pid)
 void get_flags(int argc, char const *argv[], Coordinador *c)
 {
   int opt;
+  struct option long_options[] = {
+      {"where", required_argument, NULL, 'w'},
+      {NULL, 0, NULL, 0}};
+
   c->verbose = 0;
-  while ((opt = getopt(argc, (char *const *)argv, "i:c:n:m:d")) != -1)
+  c->k = 10;
+  c->capacidad = TOPK_CAPACIDAD;
+  c->reintentos = 2;
+  c->timeout = 0; // Sin timeout salvo que se pida con -t: un worker lento no es un worker caido
+  filtro_init(&c->filtro);
+  while ((opt = getopt_long(argc, (char *const *)argv, "i:c:n:m:k:s:r:t:w:d", long_options, NULL)) != -1)
   {
     switch (opt)
     {
@@ -61,6 +81,21 @@ void get_flags(int argc, char const *argv[], Coordinador *c)
     case 'm':
       c->m = atoi(optarg);
       break;
+    case 'k':
+      c->k = atoi(optarg);
+      break;
+    case 's':
+      c->capacidad = atoi(optarg);
+      break;
+    case 'r':
+      c->reintentos = atoi(optarg);
+      break;
+    case 't':
+      c->timeout = atoi(optarg);
+      break;
+    case 'w':
+      filtro_add(&c->filtro, optarg);
+      break;
     case '?':
       printf("No existe el flag %c\n", optopt);
       break;
@@ -68,10 +103,87 @@ void get_flags(int argc, char const *argv[], Coordinador *c)
       abort();
     }
   }
+
+  // El sketch necesita al menos k + 1 contadores para saber si los k primeros están garantizados
+  if (c->k < 1 || c->k >= c->capacidad)
+  {
+    printf("El valor de k debe estar entre 1 y la capacidad del sketch menos 1 (%d)\n", c->capacidad - 1);
+    exit(EXIT_FAILURE);
+  }
+}
+
+static bool has_extension(char nombre_archivo[], const char *extension)
+{
+  size_t largo = strlen(nombre_archivo);
+  size_t largo_extension = strlen(extension);
+
+  return largo > largo_extension && strcmp(nombre_archivo + largo - largo_extension, extension) == 0;
+}
+
+static bool is_compressed(char nombre_archivo[])
+{
+  return has_extension(nombre_archivo, ".gz") || has_extension(nombre_archivo, ".zst");
+}
+
+/**
+ * @brief Lanza un proceso descompresor (gzip o zstd) que escribe el archivo descomprimido en un pipe.
+ * El pipe actua como cola acotada: el descompresor avanza en paralelo con el tokenizador y se bloquea cuando este se atrasa.
+ *
+ * @param nombre_archivo  Archivo comprimido
+ * @param descompresor    Programa a ejecutar ("gzip" o "zstd")
+ * @return FILE*          Extremo de lectura del pipe
+ */
+FILE *open_decompressor(char nombre_archivo[], char *descompresor)
+{
+  int fd[2];
+  if (pipe(fd) == -1)
+  {
+    perror("Error al crear el pipe");
+    exit(EXIT_FAILURE);
+  }
+
+  fcntl(fd[ESCRITURA], F_SETPIPE_SZ, PIPE_DESCOMPRESION); // Si falla se mantiene la capacidad por defecto
+  fcntl(fd[LECTURA], F_SETFD, FD_CLOEXEC);                 // Los workers no deben heredar la entrada
+
+  fflush(stdout);
+  pid_t pid = fork();
+  if (pid == 0)
+  {
+    close(fd[LECTURA]);
+    if (dup2(fd[ESCRITURA], STDOUT_FILENO) == -1)
+    {
+      perror("Falló dup2");
+      _exit(EXIT_FAILURE);
+    }
+
+    signal(SIGPIPE, SIG_DFL); // El coordinador ignora SIGPIPE, pero el descompresor debe terminar si se deja de leer
+    char *argv[] = {descompresor, "-dc", "--", nombre_archivo, NULL};
+    execvp(descompresor, argv);
+    perror("Falló execvp");
+    _exit(127);
+  }
+  else if (pid < 0)
+  {
+    perror("Error en fork:");
+    exit(EXIT_FAILURE);
+  }
+
+  close(fd[ESCRITURA]);
+  descompresor_pid = pid;
+
+  FILE *fp = fdopen(fd[LECTURA], "r");
+  if (fp == NULL)
+  {
+    perror("Error en fdopen");
+    exit(EXIT_FAILURE);
+  }
+
+  return fp;
 }
 
 /**
  * @brief Busca el archivo proporcionado en los argumentos para después leer sus filas.
+ * Los archivos .gz y .zst se descomprimen en streaming en un proceso aparte, sin pasar por disco.
  *
  * @param nombre_archivo
  * @throw File not found
@@ -79,7 +191,17 @@ void get_flags(int argc, char const *argv[], Coordinador *c)
  */
 FILE *read_file(char nombre_archivo[])
 {
-  FILE *fp = fopen((const char *)nombre_archivo, "r");
+  if (has_extension(nombre_archivo, ".gz"))
+  {
+    return open_decompressor(nombre_archivo, "gzip");
+  }
+
+  if (has_extension(nombre_archivo, ".zst"))
+  {
+    return open_decompressor(nombre_archivo, "zstd");
+  }
+
+  FILE *fp = fopen((const char *)nombre_archivo, "re");
   int errnum;
   if (fp == NULL)
   {
@@ -92,64 +214,135 @@ FILE *read_file(char nombre_archivo[])
 }
 
 /**
- * @brief Busca un token en particular (palabra) en una fila de caracteres.
- * @warning La fila proporcionada en los argumentos debe estar limitada por ;
- * @param row
- * @param col_number
- * @return char*
+ * @brief Cierra un archivo abierto con read_file. Si habia un descompresor, espera a que termine y verifica que no haya fallado.
+ * Un descompresor terminado por SIGPIPE no es un error: solo significa que no se leyó el archivo completo.
+ *
+ * @param fp Archivo a cerrar
+ * @return true si el archivo se leyó bien, false si el descompresor falló (el llamador decide cómo abortar)
  */
-char *find_token(char *row, int col_number)
+bool close_file(FILE *fp)
 {
-  char *row_copy = (char *)malloc(ROW_LENGHT);
-  char *token;
-  strcpy(row_copy, row);
-  for (int i = 0; i < col_number; i++)
+  fclose(fp);
+
+  if (descompresor_pid == -1)
   {
-    if (i == 0)
-    {
-      token = strtok(row_copy, ";");
-      continue;
-    }
+    return true;
+  }
+
+  int status;
+  waitpid(descompresor_pid, &status, 0);
+  descompresor_pid = -1;
+
+  bool sigpipe = WIFSIGNALED(status) && WTERMSIG(status) == SIGPIPE;
+  if (!sigpipe && (!WIFEXITED(status) || WEXITSTATUS(status) != 0))
+  {
+    printf("Error al descomprimir el archivo\n");
+    return false;
+  }
+
+  return true;
+}
 
-    token = strtok(NULL, ";");
+/**
+ * @brief Separa una fila por ; en el mismo buffer, sin copiarla. Se puede llamar varias veces para seguir separando donde quedó la llamada anterior.
+ *
+ * @param cursor  Posición desde donde seguir separando, se actualiza
+ * @param fields  Columnas de la fila
+ * @param desde   Primera columna a separar
+ * @param hasta   Última columna a separar
+ * @return int    Total de columnas separadas hasta ahora
+ */
+int split_row(char **cursor, char *fields[], int desde, int hasta)
+{
+  int i = desde;
+  for (; i <= hasta && *cursor != NULL; i++)
+  {
+    fields[i] = strsep(cursor, ";");
   }
 
-  return token;
+  return i;
 }
 
 /**
- * @brief Lee las lineas de un archivo de texto
+ * @brief Lee las lineas de un archivo de texto. El archivo se recorre una sola vez: cada llamada continúa donde quedó la anterior,
+ * por lo que el encabezado debe haberse leido antes y start debe ser la fila en la que está posicionado el archivo.
+ * Las columnas del filtro se separan primero; si la fila no lo cumple se descarta sin separar el resto ni crear el Vehiculo.
  *
  * @param fp            Archivo a leer
  * @param vehiculos     Arreglo vacio para almacenar valores
- * @param total_lineas  Total de lineas a leer del archivo
- * @warning Esta función NO se ha probado con valores de total_lineas < 0 y total_lineas > 10000.
+ * @param filtro        Predicados compilados
+ * @param start         Fila en la que está posicionado el archivo
+ * @param end           Fila hasta la que se lee
+ * @param procesadas    Se incrementa con el total de filas leidas
+ * @return int          Total de vehiculos que cumplen el filtro
  */
-void read_lines(FILE *fp, Vehiculo *vehiculos, int total_lineas, int start, int end)
+int read_lines(FILE *fp, Vehiculo *vehiculos, Filtro *filtro, int start, int end, int *procesadas)
 {
   char row[FILE_SIZE];
+  char *fields[TOTAL_COLUMNAS];
   int vehicle_idx = 0;
-  for (int i = 0; fgets(row, FILE_SIZE, fp) != NULL; i++)
+  for (int i = start; i < end && fgets(row, FILE_SIZE, fp) != NULL; i++)
   {
-    if (i == 0)
+    (*procesadas)++;
+    row[strcspn(row, "\r\n")] = '\0';
+    char *cursor = row;
+
+    int separadas = split_row(&cursor, fields, 0, filtro->columna_maxima);
+    if (separadas <= filtro->columna_maxima || !filtro_eval(filtro, fields))
     {
       continue;
     }
 
-    if (i > start && i <= end)
+    separadas = split_row(&cursor, fields, separadas, TOTAL_COLUMNAS - 1);
+    if (separadas < TOTAL_COLUMNAS) // Fila incompleta, ej: archivo comprimido truncado
     {
-      strcpy(vehiculos[vehicle_idx].grupo_vehiculo, find_token(row, 1));
-      vehiculos[vehicle_idx].tasacion = atoi(find_token(row, 6));
-      vehiculos[vehicle_idx].valor_pagado = atoi(find_token(row, 11));
-      vehiculos[vehicle_idx].puertas = atoi(find_token(row, 23));
-      vehicle_idx++;
+      continue;
     }
 
-    if (i > end)
+    snprintf(vehiculos[vehicle_idx].grupo_vehiculo, sizeof vehiculos[vehicle_idx].grupo_vehiculo, "%s", fields[COL_GRUPO_VEHICULO]);
+    vehiculos[vehicle_idx].tasacion = atoi(fields[COL_TASACION]);
+    vehiculos[vehicle_idx].valor_pagado = atoi(fields[COL_VALOR_PAGADO]);
+    vehiculos[vehicle_idx].puertas = atoi(fields[COL_PUERTAS]);
+    snprintf(vehiculos[vehicle_idx].marca, TOPK_LARGO_LLAVE, "%s", fields[COL_MARCA]);
+    snprintf(vehiculos[vehicle_idx].modelo, TOPK_LARGO_LLAVE, "%s", fields[COL_MODELO]);
+    vehicle_idx++;
+  }
+
+  return vehicle_idx;
+}
+
+/**
+ * @brief Lee solo los bloques indicados del archivo, saltando directamente a su offset. Las filas se siguen filtrando una a una con read_lines.
+ *
+ * @param fp            Archivo a leer (sin comprimir)
+ * @param indice        Indice del archivo
+ * @param bloques       Bloques a leer
+ * @param total_bloques Total de bloques a leer
+ * @param vehiculos     Arreglo vacio para almacenar valores, con espacio para BLOQUE_FILAS por bloque
+ * @param filtro        Predicados compilados
+ * @param total_lineas  Las filas desde total_lineas en adelante no se leen
+ * @param procesadas    Se incrementa con el total de filas leidas
+ * @return int          Total de vehiculos que cumplen el filtro
+ */
+int read_blocks(FILE *fp, Indice *indice, int *bloques, int total_bloques, Vehiculo *vehiculos, Filtro *filtro, int total_lineas, int *procesadas)
+{
+  int total_vehiculos = 0;
+  for (int b = 0; b < total_bloques; b++)
+  {
+    Bloque *bloque = &indice->bloques[bloques[b]];
+    int start = bloques[b] * BLOQUE_FILAS;
+    int end = start + bloque->filas < total_lineas ? start + bloque->filas : total_lineas;
+
+    if (fseek(fp, bloque->offset, SEEK_SET) == -1)
     {
-      break;
+      perror("Error en fseek");
+      exit(EXIT_FAILURE);
     }
+
+    total_vehiculos += read_lines(fp, vehiculos + total_vehiculos, filtro, start, end, procesadas);
   }
+
+  return total_vehiculos;
 }
 
 /**
@@ -174,140 +367,480 @@ void divide_array(int workers, int worker_number, int *chunk_position, int file_
 {
   int chunk_size = file_size / workers;
   int start = worker_number * chunk_size;
-  int end = start + chunk_size;
+  int end = worker_number == workers - 1 ? file_size : start + chunk_size; // El ultimo worker toma el resto de la division
 
   chunk_position[0] = start;
   chunk_position[1] = end;
 }
 
-int main(int argc, char const *argv[])
+/**
+ * @brief Lee una partición desde la posición actual del archivo y la deja en memoria.
+ *
+ * @param c           Coordinador
+ * @param fp          Archivo posicionado al inicio de la partición (sin indice)
+ * @param entrada     Entrada con las particiones
+ * @param worker      Numero del mapper
+ * @param procesadas  Se incrementa con el total de filas leidas
+ */
+void read_particion(Coordinador *c, FILE *fp, Entrada *entrada, int worker, int *procesadas)
 {
-  Coordinador coordinador;
-  get_flags(argc, argv, &coordinador);
-  int pipes[coordinador.n][2];
+  Particion *particion = &entrada->particiones[worker];
+  if (entrada->indice != NULL)
+  {
+    int total_bloques = particion->fin - particion->inicio;
+    particion->vehiculos = (Vehiculo *)calloc(total_bloques * BLOQUE_FILAS, sizeof(Vehiculo));
+    particion->total_vehiculos = read_blocks(fp, entrada->indice, entrada->candidatos + particion->inicio, total_bloques, particion->vehiculos, &c->filtro, c->total_lineas, procesadas);
+  }
+  else
+  {
+    particion->vehiculos = (Vehiculo *)calloc(particion->fin - particion->inicio, sizeof(Vehiculo));
+    particion->total_vehiculos = read_lines(fp, particion->vehiculos, &c->filtro, particion->inicio, particion->fin, procesadas);
+  }
+  particion->cargada = true;
+}
 
-  for (int i = 0; i < coordinador.n; i++)
+/**
+ * @brief Vuelve a leer del CSV una partición que ya se liberó, para reintentar su mapper.
+ *
+ * @param c       Coordinador
+ * @param entrada Entrada con las particiones
+ * @param worker  Numero del mapper
+ */
+void reload_particion(Coordinador *c, Entrada *entrada, int worker)
+{
+  FILE *fp = read_file(c->nombre_archivo);
+  if (entrada->indice == NULL && fseek(fp, entrada->particiones[worker].offset, SEEK_SET) == -1)
   {
-    if (pipe(pipes[i]) == -1)
-    {
-      perror("Error al crear el pipe");
-      exit(EXIT_FAILURE);
-    }
+    perror("Error en fseek");
+    exit(EXIT_FAILURE);
   }
 
-  for (int i = 0; i < coordinador.n; i++)
+  int procesadas = 0;
+  read_particion(c, fp, entrada, worker, &procesadas);
+  fclose(fp);
+}
+
+/**
+ * @brief Libera los vehiculos de una partición. Se usa como Finalizador cuando su mapper termina bien.
+ *
+ * @param worker  Numero del mapper
+ * @param datos   Entrada (Entrada *)
+ */
+void free_particion(int worker, void *datos)
+{
+  Particion *particion = &((Entrada *)datos)->particiones[worker];
+  free(particion->vehiculos);
+  particion->vehiculos = NULL;
+  particion->cargada = false;
+}
+
+/**
+ * @brief Escribe size bytes en un pipe no bloqueante, esperando a lo más timeout segundos cada vez que el pipe está lleno (sin límite si timeout es 0).
+ *
+ * @param expirado  Se marca en true si el lector no avanzó dentro del timeout
+ * @return true si se escribió todo, false si el lector no avanzó a tiempo o cerró el pipe
+ */
+bool write_pipe(int fd, const void *buffer, size_t size, int timeout, bool *expirado)
+{
+  size_t escritos = 0;
+  while (escritos < size)
   {
-    fflush(stdout);
-    pid_t pid = fork();
+    struct pollfd pfd = {fd, POLLOUT, 0};
+    int listos = poll(&pfd, 1, timeout > 0 ? timeout * 1000 : -1);
+    if (listos == 0)
+    {
+      *expirado = true;
+      return false;
+    }
 
-    if (pid == 0)
+    if (listos == -1)
     {
-      if (close(pipes[i][ESCRITURA]) == -1)
-      {
-        perror("Error en close");
-        exit(EXIT_FAILURE);
-      }
+      return false;
+    }
 
-      if (dup2(pipes[i][LECTURA], STDIN_FILENO) == -1)
-      {
-        perror("Falló dup2");
-        exit(EXIT_FAILURE);
-      }
+    ssize_t bytes = write(fd, (const char *)buffer + escritos, size - escritos);
+    if (bytes == -1 && errno != EAGAIN)
+    {
+      return false;
+    }
 
-      char *argv[] = {NULL};
+    if (bytes > 0)
+    {
+      escritos += bytes;
+    }
+  }
 
-      char file_size[100];
-      char chunk_size[100];
-      char worker_id[100];
+  return true;
+}
 
-      snprintf(file_size, sizeof file_size, "%d", coordinador.total_lineas);
-      snprintf(chunk_size, sizeof chunk_size, "%d", coordinador.total_lineas / coordinador.n);
-      snprintf(worker_id, sizeof worker_id, "%d", i);
+/**
+ * @brief Lanza un mapper y le envia por un pipe los vehiculos de su partición, precedidos por su cantidad.
+ * Si la entrada se puede releer, la partición se libera apenas se envía y en un reintento se vuelve a leer del CSV,
+ * así el coordinador mantiene en memoria a lo más una partición a la vez.
+ *
+ * @param c         Coordinador
+ * @param worker    Numero del mapper
+ * @param datos     Entrada (Entrada *)
+ * @param expirado  Se marca en true si el mapper no leyó su partición dentro del timeout y se terminó
+ * @return pid_t    Pid del mapper
+ */
+pid_t launch_map(Coordinador *c, int worker, void *datos, bool *expirado)
+{
+  Entrada *entrada = (Entrada *)datos;
+  Particion *particion = &entrada->particiones[worker];
+  if (!particion->cargada)
+  {
+    reload_particion(c, entrada, worker);
+  }
 
-      char *envp[] = {file_size, chunk_size, worker_id, NULL};
+  int fd[2];
+  if (pipe(fd) == -1)
+  {
+    perror("Error al crear el pipe");
+    exit(EXIT_FAILURE);
+  }
 
-      if (execve("./map", argv, envp) == -1)
-      {
-        perror("Falló exceve");
-        exit(EXIT_FAILURE);
-      }
+  fflush(stdout);
+  pid_t pid = fork();
+  if (pid == 0)
+  {
+    if (close(fd[ESCRITURA]) == -1)
+    {
+      perror("Error en close");
+      exit(EXIT_FAILURE);
+    }
 
-      exit(EXIT_SUCCESS);
+    if (dup2(fd[LECTURA], STDIN_FILENO) == -1)
+    {
+      perror("Falló dup2");
+      exit(EXIT_FAILURE);
     }
-    else if (pid < 0)
+
+    char worker_id[100];
+    char capacidad[100];
+
+    snprintf(worker_id, sizeof worker_id, "%d", worker);
+    snprintf(capacidad, sizeof capacidad, "%d", c->capacidad);
+
+    // El tamaño de la partición no va en argv: el mapper lo recibe como encabezado del pipe
+    char *argv[] = {"map", worker_id, capacidad, NULL};
+    char *envp[] = {NULL};
+
+    if (execve("./map", argv, envp) == -1)
     {
-      perror("Error en fork:");
+      perror("Falló exceve");
       exit(EXIT_FAILURE);
     }
   }
+  else if (pid < 0)
+  {
+    perror("Error en fork:");
+    exit(EXIT_FAILURE);
+  }
 
-  for (int i = 0; i < coordinador.n; i++)
+  close(fd[LECTURA]);
+  fcntl(fd[ESCRITURA], F_SETFL, O_NONBLOCK);
+
+  // Si el mapper muere o deja de leer, se termina y el fallo se detecta al esperarlo
+  if (!write_pipe(fd[ESCRITURA], &particion->total_vehiculos, sizeof(int), c->timeout, expirado) ||
+      !write_pipe(fd[ESCRITURA], particion->vehiculos, sizeof(Vehiculo) * particion->total_vehiculos, c->timeout, expirado))
   {
-    int chunk[2];
-    Vehiculo *vehiculos = (Vehiculo *)malloc(sizeof(Vehiculo *) * coordinador.total_lineas);
+    kill(pid, SIGKILL);
+  }
+  close(fd[ESCRITURA]);
+
+  if (!entrada->en_memoria)
+  {
+    free_particion(worker, entrada);
+  }
 
-    FILE *file = read_file(coordinador.nombre_archivo);
-    divide_array(coordinador.n, i, chunk, coordinador.total_lineas);
-    read_lines(file, vehiculos, coordinador.total_lineas, chunk[0], chunk[1]);
+  return pid;
+}
 
-    write(pipes[i][ESCRITURA], vehiculos, sizeof(Vehiculo *) * coordinador.total_lineas);
-    close(pipes[i][ESCRITURA]); // Cerrar el extremo de escritura del pipe en el padre
+/**
+ * @brief Lanza un reducer sobre su rango de filas intermedias.
+ *
+ * @param c         Coordinador
+ * @param worker    Numero del reducer
+ * @param datos     Total de filas intermedias (int *)
+ * @param expirado  No se usa: el timeout del reducer se controla en wait_workers
+ * @return pid_t    Pid del reducer
+ */
+pid_t launch_reduce(Coordinador *c, int worker, void *datos, bool *expirado)
+{
+  int total_filas = *(int *)datos;
 
-    free(vehiculos);
+  fflush(stdout);
+  pid_t pid = fork();
+  if (pid == 0)
+  {
+    int chunk[2];
+
+    divide_array(c->m, worker, chunk, total_filas);
+
+    char start[100];
+    char end[100];
+    char chunk_size[1000];
+    char verbose[100];
+    char worker_number[100];
+    char mappers[100];
+    char k[100];
+    char capacidad[100];
+
+    snprintf(start, sizeof start, "%d", chunk[0]);
+    snprintf(end, sizeof end, "%d", chunk[1]);
+    snprintf(chunk_size, sizeof chunk_size, "%d", chunk[1] - chunk[0]);
+    snprintf(verbose, sizeof verbose, "%d", c->verbose);
+    snprintf(worker_number, sizeof worker_number, "%d", worker);
+    snprintf(mappers, sizeof mappers, "%d", c->n);
+    snprintf(k, sizeof k, "%d", c->k);
+    snprintf(capacidad, sizeof capacidad, "%d", c->capacidad);
+
+    char *argv[] = {"reduce", start, end, chunk_size, verbose, worker_number, mappers, k, capacidad, NULL};
+    char *envp[] = {NULL};
+
+    if (execve("./reduce", argv, envp) == -1)
+    {
+      perror("execve");
+      exit(EXIT_FAILURE);
+    }
+  }
+  else if (pid < 0)
+  {
+    perror("Error en fork:");
+    exit(EXIT_FAILURE);
   }
 
-  // Esperar a que todos los hijos terminen
-  for (int i = 0; i < coordinador.n; i++)
+  return pid;
+}
+
+void start_worker(Coordinador *c, Tarea *tarea, int worker, Lanzador lanzar, void *datos)
+{
+  tarea->expirado = false;
+  tarea->pid = lanzar(c, worker, datos, &tarea->expirado);
+  tarea->intentos++;
+  tarea->inicio = time(NULL);
+  tarea->terminado = false;
+}
+
+/**
+ * @brief Termina y espera a los workers que siguen corriendo, para no dejar procesos huerfanos al abortar.
+ */
+void kill_workers(Tarea *tareas, int total)
+{
+  for (int i = 0; i < total; i++)
   {
-    wait(0);
+    if (!tareas[i].terminado)
+    {
+      kill(tareas[i].pid, SIGKILL);
+      waitpid(tareas[i].pid, NULL, 0);
+    }
   }
+}
 
-  for (int i = 0; i < coordinador.m; i++)
+/**
+ * @brief Espera a que todos los workers de una etapa terminen, identificando a cada uno por su pid.
+ * Un worker que termina con error, por una señal (ej: OOM killer) o que supera el timeout (si se pidió con -t) se vuelve a lanzar,
+ * hasta c->reintentos veces. Como cada intento publica sus archivos con rename, un reintento no duplica resultados.
+ *
+ * @param c         Coordinador
+ * @param tareas    Workers de la etapa, ya lanzados
+ * @param total     Total de workers
+ * @param lanzar    Función para relanzar un worker
+ * @param terminar  Función que se llama cuando un worker termina bien, o NULL
+ * @param datos     Datos que necesitan lanzar y terminar
+ * @param tipo      Nombre de la etapa para los mensajes ("map" o "reduce")
+ * @return true si todos los workers terminaron bien
+ */
+bool wait_workers(Coordinador *c, Tarea *tareas, int total, Lanzador lanzar, Finalizador terminar, void *datos, const char *tipo)
+{
+  int pendientes = total;
+  while (pendientes > 0)
   {
-    fflush(stdout);
+    // Sin timeout basta con bloquearse hasta que termine algún worker; con timeout hay que revisar periódicamente cuánto llevan
+    int status;
+    pid_t pid = waitpid(-1, &status, c->timeout > 0 ? WNOHANG : 0);
+    if (pid == -1)
+    {
+      perror("Error en waitpid");
+      return false;
+    }
 
-    pid_t pid = fork();
     if (pid == 0)
     {
+      for (int i = 0; i < total; i++)
+      {
+        if (!tareas[i].terminado && !tareas[i].expirado && time(NULL) - tareas[i].inicio >= c->timeout)
+        {
+          kill(tareas[i].pid, SIGKILL);
+          tareas[i].expirado = true;
+        }
+      }
 
-      printf("Hola");
-      char *argv[] = {NULL};
+      usleep(ESPERA_WORKERS_US);
+      continue;
+    }
 
-      int chunk[2];
+    int worker = -1;
+    for (int i = 0; i < total; i++)
+    {
+      if (!tareas[i].terminado && tareas[i].pid == pid)
+      {
+        worker = i;
+      }
+    }
+
+    if (worker == -1)
+    {
+      continue;
+    }
+
+    if (WIFEXITED(status) && WEXITSTATUS(status) == 0)
+    {
+      tareas[worker].terminado = true;
+      pendientes--;
+      if (terminar != NULL)
+      {
+        terminar(worker, datos);
+      }
+      continue;
+    }
 
-      divide_array(coordinador.m, i, chunk, coordinador.total_lineas);
+    if (tareas[worker].expirado)
+    {
+      printf("El %s %d (pid %d) superó el timeout de %d s\n", tipo, worker, pid, c->timeout);
+    }
+    else if (WIFSIGNALED(status))
+    {
+      printf("El %s %d (pid %d) terminó por la señal %d\n", tipo, worker, pid, WTERMSIG(status));
+    }
+    else
+    {
+      printf("El %s %d (pid %d) terminó con código %d\n", tipo, worker, pid, WEXITSTATUS(status));
+    }
 
-      char start[100];
-      char end[100];
-      char chunk_size[1000];
-      char verbose[100];
-      char worker_number[100];
+    if (tareas[worker].intentos > c->reintentos)
+    {
+      printf("El %s %d falló %d veces, se aborta la ejecución\n", tipo, worker, tareas[worker].intentos);
+      tareas[worker].terminado = true;
+      kill_workers(tareas, total);
+      return false;
+    }
 
-      snprintf(start, sizeof start, "%d", chunk[0]);
-      snprintf(end, sizeof end, "%d", chunk[1]);
-      snprintf(chunk_size, sizeof chunk_size, "%d", coordinador.total_lineas / coordinador.m);
-      snprintf(verbose, sizeof verbose, "%d", coordinador.verbose);
-      snprintf(worker_number, sizeof worker_number, "%d", i);
+    start_worker(c, &tareas[worker], worker, lanzar, datos);
+  }
 
-      char *envp[] = {start, end, chunk_size, verbose, worker_number, NULL};
+  return true;
+}
 
-      if (execve("./reduce", argv, envp) == -1)
+int main(int argc, char const *argv[])
+{
+  Coordinador coordinador;
+  get_flags(argc, argv, &coordinador);
+  signal(SIGPIPE, SIG_IGN); // Un worker caido se detecta con waitpid, no debe terminar al coordinador
+
+  FILE *file = read_file(coordinador.nombre_archivo);
+  char header[FILE_SIZE];
+  fgets(header, FILE_SIZE, file);
+  filtro_compile(&coordinador.filtro, header);
+
+  // Un CSV sin comprimir se puede releer: cada partición se libera apenas se envía y un reintento la vuelve a leer desde su offset.
+  // Una entrada comprimida o no seekable (ej: un pipe) se lee una sola vez, así que su partición se guarda hasta que el mapper termina bien.
+  Entrada entrada;
+  entrada.en_memoria = is_compressed(coordinador.nombre_archivo) || ftell(file) == -1;
+
+  // Con un filtro de fechas o números sobre un CSV que se puede recorrer con fseek se usa el indice de zonas: a los mappers solo se les asignan los bloques candidatos
+  Indice indice;
+  bool usar_indice = indice_can_prune(&coordinador.filtro) && !entrada.en_memoria && indice_load(&indice, coordinador.nombre_archivo);
+  int *candidatos = NULL;
+  int total_candidatos = 0;
+  int bloques_en_rango = 0;
+  if (usar_indice)
+  {
+    candidatos = (int *)malloc(sizeof(int) * indice.total_bloques);
+    for (int b = 0; b < indice.total_bloques && b * BLOQUE_FILAS < coordinador.total_lineas; b++)
+    {
+      bloques_en_rango++;
+      if (indice_block_may_match(&indice, b, &coordinador.filtro))
       {
-        perror("execve");
-        exit(EXIT_FAILURE);
+        candidatos[total_candidatos++] = b;
       }
     }
-    else if (pid < 0)
-    {
-      perror("Error en fork:");
-      exit(EXIT_FAILURE);
-    }
   }
 
-  // Esperar a que todos los hijos terminen
+  entrada.particiones = (Particion *)calloc(coordinador.n, sizeof(Particion));
+  entrada.indice = usar_indice ? &indice : NULL;
+  entrada.candidatos = candidatos;
+
+  Tarea *mappers = (Tarea *)calloc(coordinador.n, sizeof(Tarea));
+  int procesadas = 0;
+  int pasadas = 0;
+  for (int i = 0; i < coordinador.n; i++)
+  {
+    int chunk[2];
+    Particion *particion = &entrada.particiones[i];
+
+    divide_array(coordinador.n, i, chunk, usar_indice ? total_candidatos : coordinador.total_lineas);
+    particion->inicio = chunk[0];
+    particion->fin = chunk[1];
+    particion->offset = ftell(file);
+
+    read_particion(&coordinador, file, &entrada, i, &procesadas);
+    pasadas += particion->total_vehiculos;
+
+    start_worker(&coordinador, &mappers[i], i, launch_map, &entrada);
+  }
+
+  // Los mappers ya lanzados recibieron una entrada incompleta: se terminan antes de que publiquen sus archivos
+  if (!close_file(file))
+  {
+    kill_workers(mappers, coordinador.n);
+    exit(EXIT_FAILURE);
+  }
+
+  if (usar_indice)
+  {
+    printf("Bloques leidos: %d de %d\n", total_candidatos, bloques_en_rango);
+  }
+
+  if (coordinador.filtro.total > 0)
+  {
+    printf("Filas procesadas: %d, filas que cumplen el filtro: %d\n", procesadas, pasadas);
+  }
+
+  bool maps_ok = wait_workers(&coordinador, mappers, coordinador.n, launch_map, free_particion, &entrada, "map");
+
+  for (int i = 0; i < coordinador.n; i++)
+  {
+    free(entrada.particiones[i].vehiculos);
+  }
+  free(entrada.particiones);
+  free(mappers);
+
+  if (usar_indice)
+  {
+    free(candidatos);
+    indice_free(&indice);
+  }
+
+  if (!maps_ok)
+  {
+    exit(EXIT_FAILURE);
+  }
+
+  // Los mappers publican exactamente una fila intermedia por vehiculo recibido
+  Tarea *reducers = (Tarea *)calloc(coordinador.m, sizeof(Tarea));
   for (int i = 0; i < coordinador.m; i++)
   {
-    wait(0);
+    start_worker(&coordinador, &reducers[i], i, launch_reduce, &pasadas);
+  }
+
+  bool reduces_ok = wait_workers(&coordinador, reducers, coordinador.m, launch_reduce, NULL, &pasadas, "reduce");
+  free(reducers);
+
+  if (!reduces_ok)
+  {
+    exit(EXIT_FAILURE);
   }
 
   return 0;
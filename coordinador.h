@@ -1,3 +1,11 @@
+#include <stdbool.h>
+#include <time.h>
+#include <sys/types.h>
+
+#include "topk.h"
+#include "filtro.h"
+#include "indice.h"
+
 typedef struct
 {
   char *nombre_archivo;
@@ -5,6 +13,11 @@ typedef struct
   int verbose;
   int n;
   int m;
+  int k;
+  int capacidad;
+  int reintentos;
+  int timeout;
+  Filtro filtro;
 } Coordinador;
 
 typedef struct
@@ -13,4 +26,36 @@ typedef struct
   int tasacion;
   int valor_pagado;
   int puertas;
-} Vehiculo;
\ No newline at end of file
+  char marca[TOPK_LARGO_LLAVE];
+  char modelo[TOPK_LARGO_LLAVE];
+} Vehiculo;
+
+typedef struct
+{
+  Vehiculo *vehiculos;
+  int total_vehiculos;
+  bool cargada; /* Si vehiculos está en memoria */
+  long offset;  /* Byte del CSV donde empieza la partición (sin indice) */
+  int inicio;   /* Primera fila de la partición, o primer bloque candidato si se usa el indice */
+  int fin;
+} Particion;
+
+typedef struct
+{
+  Particion *particiones;
+  bool en_memoria; /* La entrada no se puede releer (comprimida o no seekable): cada partición se guarda hasta que su mapper termina bien */
+  Indice *indice;  /* NULL si no se usa el indice */
+  int *candidatos; /* Bloques que pueden cumplir el filtro */
+} Entrada;
+
+typedef struct
+{
+  pid_t pid;
+  int intentos;
+  time_t inicio;
+  bool terminado;
+  bool expirado;
+} Tarea;
+
+typedef pid_t (*Lanzador)(Coordinador *c, int worker, void *datos, bool *expirado); /* expirado: el lanzador mató al worker por timeout */
+typedef void (*Finalizador)(int worker, void *datos);
\ No newline at end of file
@@ -0,0 +1,287 @@
+/**
+ * @file      filtro.c
+ * @brief     Predicados --where que el coordinador evalua mientras tokeniza, para descartar filas antes de enviarlas a los mappers.
+ * @date      2026-10-18
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+
+#include "filtro.h"
+
+#define ROW_LENGHT 1000
+
+void filtro_init(Filtro *filtro)
+{
+  filtro->total = 0;
+  filtro->columna_maxima = -1;
+}
+
+/**
+ * @brief Guarda una expresión del tipo columna<op>valor. Se compila más tarde, cuando se conoce el encabezado del archivo.
+ *
+ * @param filtro    Filtro
+ * @param expresion Ej: "Forma Pago=Total", "Fecha_Pago>=01/03/2022"
+ */
+void filtro_add(Filtro *filtro, char *expresion)
+{
+  if (filtro->total == MAX_PREDICADOS)
+  {
+    printf("No se pueden usar más de %d predicados\n", MAX_PREDICADOS);
+    exit(EXIT_FAILURE);
+  }
+
+  filtro->predicados[filtro->total++].expresion = expresion;
+}
+
+static char *trim(char *text)
+{
+  while (isspace((unsigned char)*text))
+  {
+    text++;
+  }
+
+  char *end = text + strlen(text);
+  while (end > text && isspace((unsigned char)end[-1]))
+  {
+    end--;
+  }
+  *end = '\0';
+
+  return text;
+}
+
+/**
+ * @brief Normaliza un nombre de columna: solo letras y números ASCII en minúscula.
+ * Así "Año Permiso" coincide con el encabezado aunque la ñ venga mal codificada, y "Fecha Pago" con "Fecha_Pago".
+ */
+static void normalize(const char *nombre, char *normalizado, int largo)
+{
+  int idx = 0;
+  for (; *nombre != '\0' && idx < largo - 1; nombre++)
+  {
+    unsigned char c = (unsigned char)*nombre;
+    if (c < 128 && isalnum(c))
+    {
+      normalizado[idx++] = tolower(c);
+    }
+  }
+  normalizado[idx] = '\0';
+}
+
+static int find_column(char *header, char *columna)
+{
+  char header_copy[ROW_LENGHT];
+  char buscada[LARGO_VALOR];
+  char actual[LARGO_VALOR];
+
+  snprintf(header_copy, sizeof header_copy, "%s", header);
+  normalize(columna, buscada, sizeof buscada);
+
+  int idx = 0;
+  for (char *token = strtok(header_copy, ";\r\n"); token != NULL; token = strtok(NULL, ";\r\n"), idx++)
+  {
+    normalize(token, actual, sizeof actual);
+    if (strcmp(actual, buscada) == 0)
+    {
+      return idx;
+    }
+  }
+
+  return -1;
+}
+
+/**
+ * @brief Convierte una fecha dd/mm/aaaa a un número aaaammdd comparable.
+ *
+ * @return int 1 si el texto es una fecha, 0 si no
+ */
+static int parse_date(const char *text, double *fecha)
+{
+  int dia, mes, anio, consumidos = 0;
+  if (sscanf(text, "%d/%d/%d%n", &dia, &mes, &anio, &consumidos) != 3 || text[consumidos] != '\0')
+  {
+    return 0;
+  }
+
+  *fecha = anio * 10000 + mes * 100 + dia;
+  return 1;
+}
+
+static int parse_number(const char *text, double *numero)
+{
+  char *end;
+  *numero = strtod(text, &end);
+
+  return end != text && *end == '\0';
+}
+
+/**
+ * @brief Interpreta un valor como fecha o número, con las mismas reglas que usan los predicados.
+ *
+ * @param text  Valor
+ * @param valor Valor comparable (aaaammdd para fechas)
+ * @return TipoValor FECHA, NUMERO, o TEXTO si no es ninguno de los dos
+ */
+TipoValor filtro_parse_value(const char *text, double *valor)
+{
+  if (parse_date(text, valor))
+  {
+    return FECHA;
+  }
+
+  if (parse_number(text, valor))
+  {
+    return NUMERO;
+  }
+
+  return TEXTO;
+}
+
+/**
+ * @brief Resuelve la columna de cada predicado contra el encabezado y determina si el valor se compara como fecha, número o texto.
+ *
+ * @param filtro Filtro
+ * @param header Primera fila del archivo
+ * @throw Termina el programa si una expresión no es válida, la columna no existe o está fuera de las TOTAL_COLUMNAS que se leen
+ */
+void filtro_compile(Filtro *filtro, char *header)
+{
+  for (int i = 0; i < filtro->total; i++)
+  {
+    Predicado *p = &filtro->predicados[i];
+    char expresion[ROW_LENGHT];
+    snprintf(expresion, sizeof expresion, "%s", p->expresion);
+
+    char *op = strpbrk(expresion, "!<>=");
+    if (op == NULL)
+    {
+      printf("Predicado inválido: %s\n", p->expresion);
+      exit(EXIT_FAILURE);
+    }
+
+    char *valor = op + 1;
+    if (op[0] == '!' && op[1] == '=')
+    {
+      p->operador = DISTINTO;
+      valor++;
+    }
+    else if (op[0] == '<' && op[1] == '=')
+    {
+      p->operador = MENOR_IGUAL;
+      valor++;
+    }
+    else if (op[0] == '>' && op[1] == '=')
+    {
+      p->operador = MAYOR_IGUAL;
+      valor++;
+    }
+    else if (op[0] == '<')
+    {
+      p->operador = MENOR;
+    }
+    else if (op[0] == '>')
+    {
+      p->operador = MAYOR;
+    }
+    else if (op[0] == '=')
+    {
+      p->operador = IGUAL;
+    }
+    else
+    {
+      printf("Predicado inválido: %s\n", p->expresion);
+      exit(EXIT_FAILURE);
+    }
+    *op = '\0';
+
+    p->columna = find_column(header, trim(expresion));
+    if (p->columna == -1)
+    {
+      printf("No existe la columna %s\n", trim(expresion));
+      exit(EXIT_FAILURE);
+    }
+
+    // La fila se separa en un arreglo de TOTAL_COLUMNAS, una columna extra del encabezado no tiene donde quedar
+    if (p->columna >= TOTAL_COLUMNAS)
+    {
+      printf("La columna %s no se puede filtrar, solo se leen las primeras %d columnas\n", trim(expresion), TOTAL_COLUMNAS);
+      exit(EXIT_FAILURE);
+    }
+
+    snprintf(p->texto, LARGO_VALOR, "%s", trim(valor));
+    p->tipo = filtro_parse_value(p->texto, &p->numero);
+
+    if (p->columna > filtro->columna_maxima)
+    {
+      filtro->columna_maxima = p->columna;
+    }
+  }
+}
+
+static bool apply(Operador operador, int cmp)
+{
+  switch (operador)
+  {
+  case IGUAL:
+    return cmp == 0;
+  case DISTINTO:
+    return cmp != 0;
+  case MENOR:
+    return cmp < 0;
+  case MENOR_IGUAL:
+    return cmp <= 0;
+  case MAYOR:
+    return cmp > 0;
+  case MAYOR_IGUAL:
+    return cmp >= 0;
+  }
+
+  return false;
+}
+
+/**
+ * @brief Evalúa todos los predicados (AND) sobre una fila ya separada en columnas.
+ * Solo se leen las columnas hasta columna_maxima, por lo que el resto de la fila no necesita estar separada.
+ * Un valor que no se puede interpretar como fecha o número (ej: NULL) no cumple el predicado.
+ *
+ * @param filtro Filtro compilado
+ * @param fields Columnas de la fila
+ * @return true si la fila pasa el filtro
+ */
+bool filtro_eval(Filtro *filtro, char *fields[])
+{
+  for (int i = 0; i < filtro->total; i++)
+  {
+    Predicado *p = &filtro->predicados[i];
+    char *field = fields[p->columna];
+    int cmp;
+
+    if (p->tipo == TEXTO)
+    {
+      cmp = strcasecmp(field, p->texto);
+    }
+    else
+    {
+      double valor;
+      int ok = p->tipo == FECHA ? parse_date(field, &valor) : parse_number(field, &valor);
+      if (!ok)
+      {
+        return false;
+      }
+
+      cmp = (valor > p->numero) - (valor < p->numero);
+    }
+
+    if (!apply(p->operador, cmp))
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
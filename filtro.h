@@ -0,0 +1,58 @@
+#ifndef FILTRO_H
+#define FILTRO_H
+
+#include <stdbool.h>
+
+#define MAX_PREDICADOS 16
+#define LARGO_VALOR 100
+
+/* Columnas del CSV que usa el coordinador. Un predicado solo puede referirse a las primeras TOTAL_COLUMNAS */
+#define COL_GRUPO_VEHICULO 0
+#define COL_TASACION 5
+#define COL_VALOR_PAGADO 10
+#define COL_MARCA 15
+#define COL_MODELO 16
+#define COL_PUERTAS 22
+#define TOTAL_COLUMNAS 23
+
+typedef enum
+{
+  IGUAL,
+  DISTINTO,
+  MENOR,
+  MENOR_IGUAL,
+  MAYOR,
+  MAYOR_IGUAL
+} Operador;
+
+typedef enum
+{
+  TEXTO,
+  NUMERO,
+  FECHA
+} TipoValor;
+
+typedef struct
+{
+  char *expresion;
+  int columna;
+  Operador operador;
+  TipoValor tipo;
+  char texto[LARGO_VALOR];
+  double numero;
+} Predicado;
+
+typedef struct
+{
+  int total;
+  int columna_maxima;
+  Predicado predicados[MAX_PREDICADOS];
+} Filtro;
+
+void filtro_init(Filtro *filtro);
+void filtro_add(Filtro *filtro, char *expresion);
+void filtro_compile(Filtro *filtro, char *header);
+bool filtro_eval(Filtro *filtro, char *fields[]);
+TipoValor filtro_parse_value(const char *text, double *valor);
+
+#endif
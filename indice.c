@@ -0,0 +1,317 @@
+/**
+ * @file      indice.c
+ * @brief     Indice de zonas (min/max por columna cada BLOQUE_FILAS filas) para saltar bloques del CSV que no pueden cumplir el filtro.
+ * @date      2026-10-18
+ *
+ */
+
+#define _GNU_SOURCE /* strsep */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <sys/stat.h>
+
+#include "indice.h"
+#include "archivo.h"
+
+#define FILE_SIZE 9924
+#define INDICE_MAGIA 0x5a4d4150 /* "ZMAP" */
+
+static void update_zona(Zona *zona, char *field)
+{
+  double valor;
+  TipoValor tipo = filtro_parse_value(field, &valor);
+  if (tipo == TEXTO)
+  {
+    return;
+  }
+
+  if (zona->valores == 0)
+  {
+    zona->tipo = tipo;
+    zona->min = valor;
+    zona->max = valor;
+  }
+  else if (zona->tipo != tipo)
+  {
+    zona->tipo = TEXTO;
+  }
+  else if (valor < zona->min)
+  {
+    zona->min = valor;
+  }
+  else if (valor > zona->max)
+  {
+    zona->max = valor;
+  }
+
+  zona->valores++;
+}
+
+/**
+ * @brief Recorre el CSV completo y calcula las zonas de cada bloque.
+ *
+ * @param indice          Indice a construir
+ * @param nombre_archivo  CSV sin comprimir
+ * @return int            1 si se pudo construir, 0 si no
+ */
+static int indice_build(Indice *indice, char nombre_archivo[])
+{
+  char row[FILE_SIZE];
+  FILE *fp = fopen(nombre_archivo, "r");
+  if (fp == NULL || fgets(row, FILE_SIZE, fp) == NULL)
+  {
+    if (fp != NULL)
+    {
+      fclose(fp);
+    }
+    return 0;
+  }
+
+  indice->columnas = 0;
+  for (char *cursor = row; cursor != NULL && indice->columnas < INDICE_MAX_COLUMNAS; indice->columnas++)
+  {
+    strsep(&cursor, ";");
+  }
+
+  int capacidad = 64;
+  indice->total_bloques = 0;
+  indice->bloques = (Bloque *)malloc(sizeof(Bloque) * capacidad);
+
+  Bloque *bloque = NULL;
+  long offset = ftell(fp);
+  while (fgets(row, FILE_SIZE, fp) != NULL)
+  {
+    if (bloque == NULL || bloque->filas == BLOQUE_FILAS)
+    {
+      if (indice->total_bloques == capacidad)
+      {
+        capacidad *= 2;
+        indice->bloques = (Bloque *)realloc(indice->bloques, sizeof(Bloque) * capacidad);
+      }
+
+      bloque = &indice->bloques[indice->total_bloques++];
+      memset(bloque, 0, sizeof(Bloque));
+      bloque->offset = offset;
+    }
+
+    row[strcspn(row, "\r\n")] = '\0';
+    char *cursor = row;
+    for (int c = 0; c < indice->columnas && cursor != NULL; c++)
+    {
+      update_zona(&bloque->zonas[c], strsep(&cursor, ";"));
+    }
+
+    bloque->filas++;
+    offset = ftell(fp);
+  }
+
+  fclose(fp);
+  return 1;
+}
+
+/**
+ * @brief Guarda el indice junto al CSV (<archivo>.idx). Se escribe en un archivo temporal y se renombra, para que una lectura concurrente nunca vea un indice a medias.
+ * Si no se puede escribir (ej: directorio de solo lectura) el indice se usa igual, solo que se vuelve a construir en la siguiente ejecución.
+ */
+static void indice_save(Indice *indice, char *nombre_indice)
+{
+  char temporal[LARGO_RUTA];
+  temp_path(nombre_indice, temporal);
+
+  FILE *f = fopen(temporal, "wb");
+  if (f == NULL)
+  {
+    return;
+  }
+
+  int magia = INDICE_MAGIA;
+  fwrite(&magia, sizeof(int), 1, f);
+  fwrite(indice, sizeof(Indice), 1, f);
+  fwrite(indice->bloques, sizeof(Bloque), indice->total_bloques, f);
+
+  if (fclose(f) != 0 || !publish_file(nombre_indice))
+  {
+    remove(temporal);
+  }
+}
+
+static int indice_read(Indice *indice, char *nombre_indice, struct stat *info)
+{
+  FILE *f = fopen(nombre_indice, "rb");
+  if (f == NULL)
+  {
+    return 0;
+  }
+
+  int magia = 0;
+  Indice guardado;
+  if (fread(&magia, sizeof(int), 1, f) != 1 || magia != INDICE_MAGIA || fread(&guardado, sizeof(Indice), 1, f) != 1 ||
+      guardado.tamano_archivo != info->st_size || guardado.modificado != info->st_mtime)
+  {
+    fclose(f);
+    return 0;
+  }
+
+  guardado.bloques = (Bloque *)malloc(sizeof(Bloque) * (guardado.total_bloques + 1));
+  if (fread(guardado.bloques, sizeof(Bloque), guardado.total_bloques, f) != (size_t)guardado.total_bloques)
+  {
+    free(guardado.bloques);
+    fclose(f);
+    return 0;
+  }
+
+  fclose(f);
+  *indice = guardado;
+  return 1;
+}
+
+/**
+ * @brief Carga el indice del CSV. Si no existe o el CSV cambió desde que se construyó (tamaño o fecha de modificación), lo reconstruye.
+ *
+ * @param indice          Indice cargado
+ * @param nombre_archivo  CSV sin comprimir
+ * @return int            1 si hay indice, 0 si no se pudo obtener o el archivo no es regular
+ */
+int indice_load(Indice *indice, char nombre_archivo[])
+{
+  // Solo un archivo regular se puede volver a abrir y recorrer por offset; un pipe o dispositivo se consumiría al construir el indice
+  struct stat info;
+  if (stat(nombre_archivo, &info) == -1 || !S_ISREG(info.st_mode))
+  {
+    return 0;
+  }
+
+  // Un nombre como /dev/stdin o /proc/self/fd/N apunta a un archivo distinto en cada ejecución: el indice se construye pero no se guarda junto al nombre
+  char ruta[PATH_MAX];
+  bool persistente = realpath(nombre_archivo, ruta) != NULL && strncmp(ruta, "/dev/", 5) != 0 && strncmp(ruta, "/proc/", 6) != 0 &&
+                     strncmp(nombre_archivo, "/dev/", 5) != 0 && strncmp(nombre_archivo, "/proc/", 6) != 0;
+
+  char nombre_indice[FILE_SIZE];
+  snprintf(nombre_indice, sizeof nombre_indice, "%s.idx", nombre_archivo);
+
+  if (persistente && indice_read(indice, nombre_indice, &info))
+  {
+    return 1;
+  }
+
+  if (!indice_build(indice, nombre_archivo))
+  {
+    return 0;
+  }
+
+  indice->tamano_archivo = info.st_size;
+  indice->modificado = info.st_mtime;
+  if (persistente)
+  {
+    indice_save(indice, nombre_indice);
+  }
+  return 1;
+}
+
+/**
+ * @brief Indica si el filtro tiene algún predicado de fecha o número. Los de texto nunca descartan bloques,
+ * así que con solo predicados de texto construir o recorrer el indice es una lectura extra del CSV sin beneficio.
+ *
+ * @param filtro  Filtro compilado
+ * @return true si vale la pena usar el indice
+ */
+bool indice_can_prune(Filtro *filtro)
+{
+  for (int i = 0; i < filtro->total; i++)
+  {
+    if (filtro->predicados[i].tipo != TEXTO)
+    {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+/**
+ * @brief Determina, usando solo el min/max del bloque, si alguna de sus filas podría cumplir el filtro.
+ * Los predicados de texto no se pueden descartar con el indice y se dejan para el tokenizador.
+ *
+ * @param indice  Indice
+ * @param bloque  Numero de bloque
+ * @param filtro  Filtro compilado
+ * @return true si el bloque se debe leer
+ */
+bool indice_block_may_match(Indice *indice, int bloque, Filtro *filtro)
+{
+  for (int i = 0; i < filtro->total; i++)
+  {
+    Predicado *p = &filtro->predicados[i];
+    if (p->tipo == TEXTO || p->columna >= indice->columnas)
+    {
+      continue;
+    }
+
+    Zona *zona = &indice->bloques[bloque].zonas[p->columna];
+    if (zona->valores == 0) // Ningún valor del bloque se puede comparar, ninguna fila cumple
+    {
+      return false;
+    }
+
+    if (zona->tipo == TEXTO)
+    {
+      continue;
+    }
+
+    if (zona->tipo != p->tipo)
+    {
+      return false;
+    }
+
+    switch (p->operador)
+    {
+    case IGUAL:
+      if (p->numero < zona->min || p->numero > zona->max)
+      {
+        return false;
+      }
+      break;
+    case DISTINTO:
+      if (zona->min == p->numero && zona->max == p->numero)
+      {
+        return false;
+      }
+      break;
+    case MENOR:
+      if (zona->min >= p->numero)
+      {
+        return false;
+      }
+      break;
+    case MENOR_IGUAL:
+      if (zona->min > p->numero)
+      {
+        return false;
+      }
+      break;
+    case MAYOR:
+      if (zona->max <= p->numero)
+      {
+        return false;
+      }
+      break;
+    case MAYOR_IGUAL:
+      if (zona->max < p->numero)
+      {
+        return false;
+      }
+      break;
+    }
+  }
+
+  return true;
+}
+
+void indice_free(Indice *indice)
+{
+  free(indice->bloques);
+  indice->bloques = NULL;
+}
@@ -0,0 +1,40 @@
+#ifndef INDICE_H
+#define INDICE_H
+
+#include <stdbool.h>
+
+#include "filtro.h"
+
+#define BLOQUE_FILAS 256        /* Filas por bloque del indice */
+#define INDICE_MAX_COLUMNAS 32
+
+typedef struct
+{
+  TipoValor tipo; /* TEXTO si la columna mezcla fechas y números en el bloque */
+  int valores;    /* Valores que se pudieron interpretar como fecha o número */
+  double min;
+  double max;
+} Zona;
+
+typedef struct
+{
+  long offset; /* Byte de la primera fila del bloque en el CSV */
+  int filas;
+  Zona zonas[INDICE_MAX_COLUMNAS];
+} Bloque;
+
+typedef struct
+{
+  long tamano_archivo;
+  long modificado;
+  int columnas;
+  int total_bloques;
+  Bloque *bloques;
+} Indice;
+
+int indice_load(Indice *indice, char nombre_archivo[]);
+bool indice_can_prune(Filtro *filtro);
+bool indice_block_may_match(Indice *indice, int bloque, Filtro *filtro);
+void indice_free(Indice *indice);
+
+#endif
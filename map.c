@@ -18,6 +18,7 @@
 #include <stdbool.h>
 
 #include "map.h"
+#include "archivo.h"
 
 #define ROW_LENGHT 1000
 #define FILE_SIZE 9924
@@ -35,7 +36,7 @@ const char *TRANSPORTE_PUBLICO_KEY = "Transporte Publico";
  */
 Map *map_tasaciones(Vehiculo *vehiculos, int total_lineas)
 {
-  Map *map_tasacion = (Map *)malloc(sizeof(Map) * total_lineas);
+  Map *map_tasacion = (Map *)calloc(total_lineas, sizeof(Map));
   for (int i = 0; i < total_lineas; i++)
   {
     if (strcmp(vehiculos[i].grupo_vehiculo, VEHICULO_LIVIANO_KEY) == 0) // Filtramos solo los vehiculos con llave "Vehiculo Liviano"
@@ -66,7 +67,7 @@ Map *map_tasaciones(Vehiculo *vehiculos, int total_lineas)
  */
 Map *map_valor_pagado(Vehiculo vehiculos[], int total_lineas)
 {
-  Map *map_valor_pagado = (Map *)malloc(sizeof(Map) * total_lineas);
+  Map *map_valor_pagado = (Map *)calloc(total_lineas, sizeof(Map));
   for (int i = 0; i < total_lineas; i++)
   {
     if (strcmp(vehiculos[i].grupo_vehiculo, VEHICULO_LIVIANO_KEY) == 0) // Filtramos solo los vehiculos con llave "Vehiculo Liviano"
@@ -97,7 +98,7 @@ Map *map_valor_pagado(Vehiculo vehiculos[], int total_lineas)
  */
 Map *map_puertas(Vehiculo vehiculos[], int total_lineas)
 {
-  Map *map_puertas = (Map *)malloc(sizeof(Map) * total_lineas);
+  Map *map_puertas = (Map *)calloc(total_lineas, sizeof(Map));
   for (int i = 0; i < total_lineas; i++)
   {
     if (strcmp(vehiculos[i].grupo_vehiculo, VEHICULO_LIVIANO_KEY) == 0) // Filtramos solo los vehiculos con llave "Vehiculo Liviano"
@@ -119,49 +120,136 @@ Map *map_puertas(Vehiculo vehiculos[], int total_lineas)
   return map_puertas;
 }
 
-void file_create_write_line(char *filename, char *text)
+/**
+ * @brief Escribe el mapeo del chunk en un archivo propio del mapper. Se escribe completo en <filename>.tmp y se publica con rename,
+ * así un mapper que se cae a la mitad no deja filas parciales y un reintento reemplaza el archivo en vez de duplicar filas.
+ *
+ * @param map         Mapeo a escribir
+ * @param chunk_size  Total de filas
+ * @param filename    Archivo de salida
+ */
+void write_to_file(Map *map, int chunk_size, char *filename)
 {
-  FILE *f;
-  f = fopen(filename, "a");
-  fprintf(f, "%s", text);
-  fclose(f);
+  char temporal[LARGO_RUTA];
+  temp_path(filename, temporal);
+
+  FILE *f = fopen(temporal, "w");
+  if (f == NULL)
+  {
+    perror("Error al escribir el mapeo");
+    exit(1);
+  }
+
+  for (int i = 0; i < chunk_size; i++)
+  {
+    fprintf(f, "%d;%d;%d;\n", map[i].vehiculo_liviano, map[i].carga, map[i].transporte_publico);
+  }
+
+  if (fclose(f) != 0 || !publish_file(filename))
+  {
+    perror("Error al publicar el mapeo");
+    exit(1);
+  }
 }
 
-void write_to_file(Map *map, int chunk_size, char *filename)
+/**
+ * @brief Construye los sketches top-K del chunk: marcas y modelos, por cantidad y por valor pagado. Cada sketch ocupa memoria constante.
+ *
+ * @param vehiculos     Arreglo de vehiculos
+ * @param total_lineas  Total de lineas del chunk
+ * @param worker_id     Identificador del mapper, se usa para nombrar los archivos de salida
+ * @param capacidad     Contadores de cada sketch
+ */
+void map_top_k(Vehiculo vehiculos[], int total_lineas, int worker_id, int capacidad)
 {
-  for (int i = 0; i < chunk_size; i++)
+  TopK marca_cantidad, modelo_cantidad, marca_valor_pagado, modelo_valor_pagado;
+  topk_init(&marca_cantidad, capacidad);
+  topk_init(&modelo_cantidad, capacidad);
+  topk_init(&marca_valor_pagado, capacidad);
+  topk_init(&modelo_valor_pagado, capacidad);
+
+  for (int i = 0; i < total_lineas; i++)
   {
-    int vehiculo_liviano = map[i].vehiculo_liviano;
-    int carga = map[i].carga;
-    int transporte_publico = map[i].transporte_publico;
+    topk_update(&marca_cantidad, vehiculos[i].marca, 1);
+    topk_update(&modelo_cantidad, vehiculos[i].modelo, 1);
+    topk_update(&marca_valor_pagado, vehiculos[i].marca, vehiculos[i].valor_pagado);
+    topk_update(&modelo_valor_pagado, vehiculos[i].modelo, vehiculos[i].valor_pagado);
+  }
 
-    char buffer[30];
-    snprintf(buffer, sizeof buffer, "%d;%d;%d;\n", vehiculo_liviano, carga, transporte_publico);
+  char filename[100];
+  snprintf(filename, sizeof filename, "input_files/topk_marca_cantidad_%d.csv", worker_id);
+  topk_write(&marca_cantidad, filename);
+  snprintf(filename, sizeof filename, "input_files/topk_modelo_cantidad_%d.csv", worker_id);
+  topk_write(&modelo_cantidad, filename);
+  snprintf(filename, sizeof filename, "input_files/topk_marca_valor_pagado_%d.csv", worker_id);
+  topk_write(&marca_valor_pagado, filename);
+  snprintf(filename, sizeof filename, "input_files/topk_modelo_valor_pagado_%d.csv", worker_id);
+  topk_write(&modelo_valor_pagado, filename);
+
+  topk_free(&marca_cantidad);
+  topk_free(&modelo_cantidad);
+  topk_free(&marca_valor_pagado);
+  topk_free(&modelo_valor_pagado);
+}
 
-    file_create_write_line(filename, buffer);
+/**
+ * @brief Lee exactamente size bytes desde el pipe del coordinador (STDIN). Un pipe entrega a lo mas su capacidad por read.
+ *
+ * @param buffer  Destino
+ * @param size    Bytes a leer
+ */
+void read_pipe(void *buffer, size_t size)
+{
+  size_t leidos = 0;
+  while (leidos < size)
+  {
+    ssize_t bytes = read(STDIN_FILENO, (char *)buffer + leidos, size - leidos);
+    if (bytes == -1)
+    {
+      perror("Error en read:");
+      exit(1);
+    }
+
+    if (bytes == 0)
+    {
+      printf("El coordinador cerró el pipe antes de tiempo\n");
+      exit(1);
+    }
+
+    leidos += bytes;
   }
 }
 
 int main(int argc, char const *argv[])
 {
-  int file_size = atoi(argv[1]);
-  int chunk_size = atoi(argv[2]);
-  int worker_id = atoi(argv[3]);
+  int worker_id = atoi(argv[1]);
+  int capacidad = atoi(argv[2]);
 
-  Vehiculo *vehiculos = (Vehiculo *)malloc(sizeof(Vehiculo) * file_size);
-  if (read(STDIN_FILENO, vehiculos, sizeof(Vehiculo) * file_size) == -1)
+  // El coordinador envia primero cuantos vehiculos del chunk cumplen el filtro y luego solo esos vehiculos
+  int total_vehiculos = 0;
+  read_pipe(&total_vehiculos, sizeof(int));
+  if (total_vehiculos < 0)
   {
-    perror("Error en read:");
+    printf("Cantidad de vehiculos invalida: %d\n", total_vehiculos);
     exit(1);
   }
 
-  Map *tasaciones = map_tasaciones(vehiculos, chunk_size);
-  Map *valor_pagado = map_valor_pagado(vehiculos, chunk_size);
-  Map *puertas = map_puertas(vehiculos, chunk_size);
+  Vehiculo *vehiculos = (Vehiculo *)calloc(total_vehiculos, sizeof(Vehiculo));
+  read_pipe(vehiculos, sizeof(Vehiculo) * total_vehiculos);
+
+  Map *tasaciones = map_tasaciones(vehiculos, total_vehiculos);
+  Map *valor_pagado = map_valor_pagado(vehiculos, total_vehiculos);
+  Map *puertas = map_puertas(vehiculos, total_vehiculos);
+
+  char filename[100];
+  snprintf(filename, sizeof filename, "input_files/tasaciones_%d.csv", worker_id);
+  write_to_file(tasaciones, total_vehiculos, filename);
+  snprintf(filename, sizeof filename, "input_files/valor_pagado_%d.csv", worker_id);
+  write_to_file(valor_pagado, total_vehiculos, filename);
+  snprintf(filename, sizeof filename, "input_files/puertas_%d.csv", worker_id);
+  write_to_file(puertas, total_vehiculos, filename);
 
-  write_to_file(tasaciones, chunk_size, "input_files/tasaciones.csv");
-  write_to_file(valor_pagado, chunk_size, "input_files/valor_pagado.csv");
-  write_to_file(puertas, chunk_size, "input_files/puertas.csv");
+  map_top_k(vehiculos, total_vehiculos, worker_id, capacidad);
 
   return 0;
 }
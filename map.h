@@ -1,12 +1,16 @@
 #ifndef MAP_H
 #define MAP_H
 
+#include "topk.h"
+
 typedef struct
 {
   char grupo_vehiculo[20];
   int tasacion;
   int valor_pagado;
   int puertas;
+  char marca[TOPK_LARGO_LLAVE];
+  char modelo[TOPK_LARGO_LLAVE];
 } Vehiculo;
 
 typedef struct
@@ -19,5 +23,6 @@ typedef struct
 Map *map_tasaciones(Vehiculo vehiculos[], int total_lineas);
 Map *map_valor_pagado(Vehiculo vehiculos[], int total_lineas);
 Map *map_puertas(Vehiculo vehiculos[], int total_lineas);
+void map_top_k(Vehiculo vehiculos[], int total_lineas, int worker_id, int capacidad);
 
 #endif
\ No newline at end of file
@@ -19,27 +19,51 @@
 #include <sys/types.h>
 
 #include "map.h"
+#include "topk.h"
+#include "archivo.h"
 #define ROW_LENGHT 1000
 #define FILE_SIZE 9924
+#define TOP_K_OUTPUT "output_files/top_k.txt"
 
 void file_create_write_line(char *filename, char *text)
 {
   FILE *f;
   f = fopen(filename, "a");
+  if (f == NULL)
+  {
+    perror("Error al escribir el resultado");
+    exit(EXIT_FAILURE);
+  }
 
   fprintf(f, "%s", text);
   fclose(f);
 }
 
+/**
+ * @brief Publica un resultado renombrando <filename>.tmp a filename. Un intento que falla antes de llegar aquí no deja resultados parciales.
+ *
+ * @param filename Nombre final del archivo
+ */
+void commit_file(char *filename)
+{
+  if (!publish_file(filename))
+  {
+    perror("Error al publicar el resultado");
+    exit(EXIT_FAILURE);
+  }
+}
+
 void write_results(int vehiculo_liviano, int carga, int transporte_publico, char *group_name, int worker_number)
 {
   char text[1000];
   snprintf(text, sizeof(char) * 1000, "Total de %s para vehiculo liviano:%i\nTotal de %s para vehiculo de carga:%i\nTotal de %s para vehiculo de transporte:%i\n", group_name, vehiculo_liviano, group_name, carga, group_name, transporte_publico);
 
-  char filename[35];
-  snprintf(filename, sizeof(char) * 35, "output_files/worker_%i_output.txt", worker_number);
+  char filename[100];
+  char temporal[LARGO_RUTA];
+  snprintf(filename, sizeof(char) * 100, "output_files/worker_%i_output.txt", worker_number);
+  temp_path(filename, temporal);
 
-  file_create_write_line(filename, text);
+  file_create_write_line(temporal, text);
 }
 
 /**
@@ -122,14 +146,24 @@ char *find_token(char *row, int col_number)
   return token;
 }
 
-void read_lines(FILE *fp, Map *map, int start, int end)
+/**
+ * @brief Lee las filas [start, end) de un archivo intermedio, contando las filas desde fila.
+ *
+ * @param fp    Archivo intermedio
+ * @param map   Arreglo donde se dejan las filas
+ * @param start Primera fila
+ * @param end   Fila final (exclusiva)
+ * @param fila  Numero de la primera fila del archivo, se actualiza con las filas leidas
+ * @return int  Total de filas guardadas en map
+ */
+int read_lines(FILE *fp, Map *map, int start, int end, int *fila)
 {
 
   char row[FILE_SIZE];
   int vehicle_idx = 0;
-  for (int i = 0; fgets(row, FILE_SIZE, fp) != NULL; i++)
+  for (int i = *fila; i < end && fgets(row, FILE_SIZE, fp) != NULL; i++, (*fila)++)
   {
-    if (i > start && i <= end)
+    if (i >= start)
     {
       map[vehicle_idx].vehiculo_liviano = atoi(find_token(row, 1));
       map[vehicle_idx].carga = atoi(find_token(row, 2));
@@ -137,12 +171,51 @@ void read_lines(FILE *fp, Map *map, int start, int end)
 
       vehicle_idx++;
     }
+  }
 
-    if (i > end)
-    {
-      break;
-    }
+  return vehicle_idx;
+}
+
+FILE *read_file(char nombre_archivo[])
+{
+  FILE *fp = fopen((const char *)nombre_archivo, "r");
+  int errnum;
+  if (fp == NULL)
+  {
+    errnum = errno;
+    printf("Error al abrir el archivo: %s\n", strerror(errnum));
+    exit(-1);
   }
+
+  return fp;
+}
+
+/**
+ * @brief Lee las filas [start, end) de la concatenación de los archivos intermedios de todos los mappers, en orden de mapper.
+ * Cada mapper publica su archivo completo de una vez, así que un mapper reintentado nunca duplica filas.
+ *
+ * @param name    Nombre del archivo intermedio (ej: tasaciones)
+ * @param mappers Total de mappers
+ * @param map     Arreglo donde se dejan las filas
+ * @param start   Primera fila
+ * @param end     Fila final (exclusiva)
+ * @return int    Total de filas leidas
+ */
+int read_intermediate(char *name, int mappers, Map *map, int start, int end)
+{
+  char filename[100];
+  int fila = 0;
+  int total = 0;
+
+  for (int i = 0; i < mappers && fila < end; i++)
+  {
+    snprintf(filename, sizeof filename, "input_files/%s_%d.csv", name, i);
+    FILE *fp = read_file(filename);
+    total += read_lines(fp, map + total, start, end, &fila);
+    fclose(fp);
+  }
+
+  return total;
 }
 
 /**
@@ -208,44 +281,116 @@ void reduce_puertas(Map *puertas, int verbose, int start, int end)
   }
 }
 
-FILE *read_file(char nombre_archivo[])
+/**
+ * @brief Mezcla los sketches top-K escritos por cada mapper y escribe los k primeros ordenados junto a su cota de error.
+ * El conteo reportado es una cota superior; el valor real esta entre conteo - error y conteo.
+ * Si el conteo garantizado (conteo - error) de una llave no supera al conteo estimado del k+1-esimo, la llave podria no estar
+ * realmente en el top-K y se marca como "no garantizado".
+ *
+ * @param sketch_name   Nombre del sketch (ej: marca_cantidad)
+ * @param title         Titulo a escribir en la salida
+ * @param mappers       Total de mappers que escribieron sketches
+ * @param k             Total de elementos a reportar
+ * @param capacidad     Contadores de cada sketch
+ * @param verbose       Valor que determina si queremos imprimir por consola {0, 1}
+ */
+void reduce_top_k(char *sketch_name, char *title, int mappers, int k, int capacidad, int verbose)
 {
-  FILE *fp = fopen((const char *)nombre_archivo, "r");
-  int errnum;
-  if (fp == NULL)
+  TopK resultado;
+  TopK sketch;
+  char filename[100];
+  topk_init(&resultado, capacidad);
+  topk_init(&sketch, capacidad);
+
+  for (int i = 0; i < mappers; i++)
   {
-    errnum = errno;
-    printf("Error al abrir el archivo: %s\n", strerror(errnum));
-    exit(-1);
+    snprintf(filename, sizeof filename, "input_files/topk_%s_%d.csv", sketch_name, i);
+    if (topk_read(&sketch, filename) == 0)
+    {
+      printf("No se pudo leer el sketch %s\n", filename);
+      exit(EXIT_FAILURE);
+    }
+
+    topk_merge(&resultado, &sketch);
   }
 
-  return fp;
+  topk_sort(&resultado);
+
+  char temporal[LARGO_RUTA];
+  temp_path(TOP_K_OUTPUT, temporal);
+
+  char text[ROW_LENGHT];
+  snprintf(text, sizeof text, "Top %d %s (total %ld, error maximo %ld):\n", k, title, resultado.total, resultado.total / capacidad);
+  file_create_write_line(temporal, text);
+  if (verbose == 1)
+  {
+    printf("%s", text);
+  }
+
+  long siguiente = resultado.usados > k ? resultado.contadores[k].conteo : 0;
+  for (int i = 0; i < k && i < resultado.usados; i++)
+  {
+    Contador c = resultado.contadores[i];
+    snprintf(text, sizeof text, "%d. %s: %ld (error <= %ld)%s\n", i + 1, c.llave[0] == '\0' ? "(vacio)" : c.llave, c.conteo, c.error,
+             c.conteo - c.error > siguiente ? "" : " (no garantizado)");
+    file_create_write_line(temporal, text);
+    if (verbose == 1)
+    {
+      printf("%s", text);
+    }
+  }
+
+  topk_free(&resultado);
+  topk_free(&sketch);
 }
 
 int main(int argc, char const *argv[])
 {
-  FILE *tfp = read_file("input_files/tasaciones.csv");
-  FILE *vpfp = read_file("input_files/valor_pagado.csv");
-  FILE *pfp = read_file("input_files/puertas.csv");
-
   int start = atoi(argv[1]);
   int end = atoi(argv[2]);
   int chunk_size = atoi(argv[3]);
   int verbose = atoi(argv[4]);
   int worker_number = atoi(argv[5]);
+  int mappers = atoi(argv[6]);
+  int k = atoi(argv[7]);
+  int capacidad = atoi(argv[8]);
 
-  Map *map_tasaciones = (Map *)malloc(sizeof(Map) * chunk_size);
-  Map *map_valor_pagado = (Map *)malloc(sizeof(Map) * chunk_size);
-  Map *map_puertas = (Map *)malloc(sizeof(Map) * chunk_size);
+  Map *map_tasaciones = (Map *)malloc(sizeof(Map) * (end - start));
+  Map *map_valor_pagado = (Map *)malloc(sizeof(Map) * (end - start));
+  Map *map_puertas = (Map *)malloc(sizeof(Map) * (end - start));
 
   printf("%d ", chunk_size);
 
-  read_lines(tfp, map_tasaciones, start, end);
-  read_lines(vpfp, map_valor_pagado, start, end);
+  char output[100];
+  snprintf(output, sizeof output, "output_files/worker_%i_output.txt", worker_number);
+
+  // Cada intento parte de archivos temporales vacios y los publica al terminar
+  char temporal[LARGO_RUTA];
+  temp_path(output, temporal);
+  remove(temporal);
+  if (worker_number == 0)
+  {
+    temp_path(TOP_K_OUTPUT, temporal);
+    remove(temporal);
+  }
+
+  int total_tasaciones = read_intermediate("tasaciones", mappers, map_tasaciones, start, end);
+  int total_valor_pagado = read_intermediate("valor_pagado", mappers, map_valor_pagado, start, end);
 
-  reduce_tasacion(map_tasaciones, verbose, chunk_size, worker_number);
+  reduce_tasacion(map_tasaciones, verbose, total_tasaciones, worker_number);
   // reduce_puertas(map_puertas, verbose, start, end, worker_number);
-  reduce_valor_pagado(map_valor_pagado, verbose, start, end, worker_number);
+  reduce_valor_pagado(map_valor_pagado, verbose, 0, total_valor_pagado, worker_number);
+
+  if (worker_number == 0) // Los sketches son pequeños, basta con que un reducer los mezcle
+  {
+    reduce_top_k("marca_cantidad", "marcas por cantidad", mappers, k, capacidad, verbose);
+    reduce_top_k("modelo_cantidad", "modelos por cantidad", mappers, k, capacidad, verbose);
+    reduce_top_k("marca_valor_pagado", "marcas por valor pagado", mappers, k, capacidad, verbose);
+    reduce_top_k("modelo_valor_pagado", "modelos por valor pagado", mappers, k, capacidad, verbose);
+    commit_file(TOP_K_OUTPUT);
+  }
+
+  commit_file(output);
 
   return 0;
 }
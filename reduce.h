@@ -2,4 +2,5 @@
 
 void reduce_tasacion(Map *tasaciones, int verbose, int total_lineas);
 void reduce_valor_pagado(Map *valor_pagado, int verbose, int total_lineas);
-void reduce_puertas(Map *valor_pagado, int verbose, int total_lineas);
\ No newline at end of file
+void reduce_puertas(Map *valor_pagado, int verbose, int total_lineas);
+void reduce_top_k(char *sketch_name, char *title, int mappers, int k, int capacidad, int verbose);
\ No newline at end of file
@@ -0,0 +1,415 @@
+/**
+ * @file      topk.c
+ * @brief     Sketch Space-Saving para obtener los K elementos mas frecuentes (o de mayor peso) con memoria constante.
+ * @date      2026-10-18
+ *
+ */
+
+#define _GNU_SOURCE /* strsep */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <stdbool.h>
+
+#include "topk.h"
+#include "archivo.h"
+
+#define ROW_LENGHT 1000
+
+/**
+ * @brief Convierte un campo numerico del sketch. A diferencia de atol, rechaza campos vacios o con basura.
+ *
+ * @return int 1 si el campo es un numero valido, 0 si no
+ */
+static int parse_long(const char *text, long *valor)
+{
+  if (text == NULL)
+  {
+    return 0;
+  }
+
+  char *end;
+  errno = 0;
+  *valor = strtol(text, &end, 10);
+
+  return errno == 0 && end != text && *end == '\0';
+}
+
+/**
+ * @brief Deja un sketch vacio con capacidad contadores. La memoria se reserva una sola vez y no crece con la entrada.
+ *
+ * @param topk      Sketch a inicializar
+ * @param capacidad Total de contadores
+ */
+void topk_init(TopK *topk, int capacidad)
+{
+  memset(topk, 0, sizeof(TopK));
+  topk->capacidad = capacidad;
+
+  // La tabla hash tiene al menos el doble de cubetas que contadores, en potencia de 2 para usar una mascara
+  topk->total_cubetas = 1;
+  while (topk->total_cubetas < capacidad * 2)
+  {
+    topk->total_cubetas *= 2;
+  }
+
+  topk->contadores = (Contador *)calloc(capacidad, sizeof(Contador));
+  topk->heap = (int *)calloc(capacidad, sizeof(int));
+  topk->cubetas = (int *)malloc(sizeof(int) * topk->total_cubetas);
+  if (topk->contadores == NULL || topk->heap == NULL || topk->cubetas == NULL)
+  {
+    perror("Error al reservar el sketch");
+    exit(EXIT_FAILURE);
+  }
+
+  memset(topk->cubetas, -1, sizeof(int) * topk->total_cubetas);
+}
+
+void topk_free(TopK *topk)
+{
+  free(topk->contadores);
+  free(topk->heap);
+  free(topk->cubetas);
+  topk->contadores = NULL;
+  topk->heap = NULL;
+  topk->cubetas = NULL;
+}
+
+/* FNV-1a */
+static unsigned int hash(const char *llave)
+{
+  unsigned int h = 2166136261u;
+  for (; *llave != '\0'; llave++)
+  {
+    h = (h ^ (unsigned char)*llave) * 16777619u;
+  }
+
+  return h;
+}
+
+static int *cubeta(TopK *topk, const char *llave)
+{
+  return &topk->cubetas[hash(llave) & (topk->total_cubetas - 1)];
+}
+
+static int find_contador(TopK *topk, const char *llave)
+{
+  int idx = *cubeta(topk, llave);
+  while (idx != -1 && strcmp(topk->contadores[idx].llave, llave) != 0)
+  {
+    idx = topk->contadores[idx].siguiente;
+  }
+
+  return idx;
+}
+
+static void insert_cubeta(TopK *topk, int idx)
+{
+  int *primero = cubeta(topk, topk->contadores[idx].llave);
+  topk->contadores[idx].siguiente = *primero;
+  *primero = idx;
+}
+
+static void remove_cubeta(TopK *topk, int idx)
+{
+  int *actual = cubeta(topk, topk->contadores[idx].llave);
+  while (*actual != idx)
+  {
+    actual = &topk->contadores[*actual].siguiente;
+  }
+  *actual = topk->contadores[idx].siguiente;
+}
+
+static long conteo_heap(TopK *topk, int posicion)
+{
+  return topk->contadores[topk->heap[posicion]].conteo;
+}
+
+static void swap_heap(TopK *topk, int a, int b)
+{
+  int idx = topk->heap[a];
+  topk->heap[a] = topk->heap[b];
+  topk->heap[b] = idx;
+  topk->contadores[topk->heap[a]].posicion = a;
+  topk->contadores[topk->heap[b]].posicion = b;
+}
+
+/**
+ * @brief Devuelve al contador de la posicion indicada a su lugar en el heap despues de que cambió su conteo.
+ */
+static void fix_heap(TopK *topk, int posicion)
+{
+  while (posicion > 0 && conteo_heap(topk, posicion) < conteo_heap(topk, (posicion - 1) / 2))
+  {
+    swap_heap(topk, posicion, (posicion - 1) / 2);
+    posicion = (posicion - 1) / 2;
+  }
+
+  while (true)
+  {
+    int menor = posicion;
+    int izquierdo = posicion * 2 + 1;
+    int derecho = posicion * 2 + 2;
+    if (izquierdo < topk->usados && conteo_heap(topk, izquierdo) < conteo_heap(topk, menor))
+    {
+      menor = izquierdo;
+    }
+    if (derecho < topk->usados && conteo_heap(topk, derecho) < conteo_heap(topk, menor))
+    {
+      menor = derecho;
+    }
+    if (menor == posicion)
+    {
+      return;
+    }
+
+    swap_heap(topk, posicion, menor);
+    posicion = menor;
+  }
+}
+
+/**
+ * @brief Reconstruye la tabla hash y el heap a partir de los contadores, despues de reordenarlos o reemplazarlos en bloque.
+ */
+static void rebuild(TopK *topk)
+{
+  memset(topk->cubetas, -1, sizeof(int) * topk->total_cubetas);
+  for (int i = 0; i < topk->usados; i++)
+  {
+    insert_cubeta(topk, i);
+    topk->heap[i] = i;
+    topk->contadores[i].posicion = i;
+  }
+
+  for (int i = topk->usados / 2 - 1; i >= 0; i--)
+  {
+    fix_heap(topk, i);
+  }
+}
+
+/**
+ * @brief Conteo minimo que puede tener una llave ausente del sketch. Si el sketch no esta lleno es 0, porque toda llave vista tiene contador.
+ *
+ * @param topk Sketch
+ * @return long
+ */
+static long conteo_ausente(TopK *topk)
+{
+  if (topk->usados < topk->capacidad)
+  {
+    return 0;
+  }
+
+  return conteo_heap(topk, 0);
+}
+
+/**
+ * @brief Suma peso a la llave. Si la llave no tiene contador y el sketch esta lleno, reemplaza al contador minimo (la raiz del heap) y hereda su conteo como error.
+ *
+ * @param topk  Sketch
+ * @param llave Marca o modelo
+ * @param peso  1 para contar ocurrencias, o el valor a acumular (ej: valor pagado)
+ */
+void topk_update(TopK *topk, const char *llave, long peso)
+{
+  topk->total += peso;
+
+  // Se busca la llave ya truncada, igual a como queda guardada en el contador
+  char truncada[TOPK_LARGO_LLAVE];
+  snprintf(truncada, sizeof truncada, "%s", llave);
+
+  int idx = find_contador(topk, truncada);
+  if (idx >= 0)
+  {
+    topk->contadores[idx].conteo += peso;
+    fix_heap(topk, topk->contadores[idx].posicion);
+    return;
+  }
+
+  if (topk->usados < topk->capacidad)
+  {
+    idx = topk->usados;
+    topk->contadores[idx].conteo = 0;
+    topk->contadores[idx].error = 0;
+    topk->contadores[idx].posicion = topk->usados;
+    topk->heap[topk->usados++] = idx;
+  }
+  else
+  {
+    idx = topk->heap[0];
+    remove_cubeta(topk, idx);
+    topk->contadores[idx].error = topk->contadores[idx].conteo;
+  }
+
+  memcpy(topk->contadores[idx].llave, truncada, sizeof truncada);
+  insert_cubeta(topk, idx);
+  topk->contadores[idx].conteo += peso;
+  fix_heap(topk, topk->contadores[idx].posicion);
+}
+
+static int compare_contadores(const void *a, const void *b)
+{
+  long conteo_a = ((Contador *)a)->conteo;
+  long conteo_b = ((Contador *)b)->conteo;
+
+  if (conteo_a == conteo_b)
+  {
+    return strcmp(((Contador *)a)->llave, ((Contador *)b)->llave);
+  }
+
+  return conteo_a < conteo_b ? 1 : -1;
+}
+
+/**
+ * @brief Ordena los contadores de mayor a menor conteo.
+ *
+ * @param topk Sketch
+ */
+void topk_sort(TopK *topk)
+{
+  qsort(topk->contadores, topk->usados, sizeof(Contador), compare_contadores);
+  rebuild(topk);
+}
+
+/**
+ * @brief Mezcla origen dentro de destino. Una llave que falta en uno de los sketches suma el conteo minimo de ese sketch tanto a su conteo como a su error,
+ * de modo que el resultado sigue siendo una cota superior y el error sigue acotado por total / capacidad.
+ *
+ * @param destino Sketch que recibe la mezcla
+ * @param origen  Sketch a mezclar
+ */
+void topk_merge(TopK *destino, TopK *origen)
+{
+  Contador *union_contadores = (Contador *)malloc(sizeof(Contador) * (destino->usados + origen->usados + 1));
+  int total_union = 0;
+  long ausente_destino = conteo_ausente(destino);
+  long ausente_origen = conteo_ausente(origen);
+
+  for (int i = 0; i < destino->usados; i++)
+  {
+    Contador c = destino->contadores[i];
+    int idx = find_contador(origen, c.llave);
+    if (idx >= 0)
+    {
+      c.conteo += origen->contadores[idx].conteo;
+      c.error += origen->contadores[idx].error;
+    }
+    else
+    {
+      c.conteo += ausente_origen;
+      c.error += ausente_origen;
+    }
+
+    union_contadores[total_union++] = c;
+  }
+
+  for (int i = 0; i < origen->usados; i++)
+  {
+    Contador c = origen->contadores[i];
+    if (find_contador(destino, c.llave) >= 0)
+    {
+      continue;
+    }
+
+    c.conteo += ausente_destino;
+    c.error += ausente_destino;
+    union_contadores[total_union++] = c;
+  }
+
+  qsort(union_contadores, total_union, sizeof(Contador), compare_contadores);
+
+  destino->usados = total_union < destino->capacidad ? total_union : destino->capacidad;
+  destino->total += origen->total;
+  memcpy(destino->contadores, union_contadores, sizeof(Contador) * destino->usados);
+  free(union_contadores);
+  rebuild(destino);
+}
+
+/**
+ * @brief Escribe el sketch en un archivo. La primera linea es total;usados; y luego una linea llave;conteo;error; por contador.
+ * Se escribe en <filename>.tmp y se publica con rename, para que nunca se lea un sketch a medias.
+ *
+ * @param topk      Sketch
+ * @param filename  Archivo de salida (se sobreescribe)
+ */
+void topk_write(TopK *topk, char *filename)
+{
+  char temporal[LARGO_RUTA];
+  temp_path(filename, temporal);
+
+  FILE *f = fopen(temporal, "w");
+  if (f == NULL)
+  {
+    perror("Error al escribir el sketch");
+    exit(EXIT_FAILURE);
+  }
+
+  fprintf(f, "%ld;%d;\n", topk->total, topk->usados);
+  for (int i = 0; i < topk->usados; i++)
+  {
+    fprintf(f, "%s;%ld;%ld;\n", topk->contadores[i].llave, topk->contadores[i].conteo, topk->contadores[i].error);
+  }
+
+  if (fclose(f) != 0 || !publish_file(filename))
+  {
+    perror("Error al publicar el sketch");
+    exit(EXIT_FAILURE);
+  }
+}
+
+/**
+ * @brief Lee un sketch escrito con topk_write. Si el archivo tiene más contadores que la capacidad del sketch se considera inválido.
+ *
+ * @param topk      Sketch ya inicializado donde se deja el resultado
+ * @param filename  Archivo a leer
+ * @return int      1 si se pudo leer, 0 si el archivo no existe o esta incompleto
+ */
+int topk_read(TopK *topk, char *filename)
+{
+  char row[ROW_LENGHT];
+  topk->usados = 0;
+  topk->total = 0;
+
+  FILE *f = fopen(filename, "r");
+  if (f == NULL)
+  {
+    return 0;
+  }
+
+  int usados = 0;
+  if (fgets(row, ROW_LENGHT, f) == NULL || sscanf(row, "%ld;%d;", &topk->total, &usados) != 2 || usados < 0 || usados > topk->capacidad)
+  {
+    fclose(f);
+    return 0;
+  }
+
+  for (int i = 0; i < usados; i++)
+  {
+    if (fgets(row, ROW_LENGHT, f) == NULL)
+    {
+      fclose(f);
+      return 0;
+    }
+
+    // Con strsep una llave vacia (ej: ";248;0;") se mantiene como columna vacia en vez de correr las demas columnas
+    row[strcspn(row, "\r\n")] = '\0';
+    char *cursor = row;
+    char *llave = strsep(&cursor, ";");
+    char *conteo = strsep(&cursor, ";");
+    char *error = strsep(&cursor, ";");
+    if (!parse_long(conteo, &topk->contadores[i].conteo) || !parse_long(error, &topk->contadores[i].error))
+    {
+      fclose(f);
+      return 0;
+    }
+
+    snprintf(topk->contadores[i].llave, TOPK_LARGO_LLAVE, "%s", llave);
+  }
+
+  topk->usados = usados;
+  rebuild(topk);
+  fclose(f);
+  return 1;
+}
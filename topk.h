@@ -0,0 +1,35 @@
+#ifndef TOPK_H
+#define TOPK_H
+
+#define TOPK_CAPACIDAD 1024  /* Contadores por sketch por defecto, fija la memoria sin importar el tamaño de la entrada */
+#define TOPK_LARGO_LLAVE 50  /* Largo maximo de Marca / Modelo */
+
+typedef struct
+{
+  char llave[TOPK_LARGO_LLAVE];
+  long conteo;
+  long error;
+  int siguiente; /* Siguiente contador de la misma cubeta, -1 si es el ultimo */
+  int posicion;  /* Posicion del contador en el heap */
+} Contador;
+
+typedef struct
+{
+  int capacidad;
+  int usados;
+  long total;
+  Contador *contadores;
+  int *heap;          /* Indices de contadores ordenados como min-heap por conteo */
+  int *cubetas;       /* Tabla hash: primer contador de cada cubeta, -1 si esta vacia */
+  int total_cubetas;
+} TopK;
+
+void topk_init(TopK *topk, int capacidad);
+void topk_free(TopK *topk);
+void topk_update(TopK *topk, const char *llave, long peso);
+void topk_merge(TopK *destino, TopK *origen);
+void topk_sort(TopK *topk);
+void topk_write(TopK *topk, char *filename);
+int topk_read(TopK *topk, char *filename);
+
+#endif